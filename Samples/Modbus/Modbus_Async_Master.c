@@ -0,0 +1,236 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/* Modbus_Async_Master.c
+
+Poll cycle benchmark for the non-blocking Modbus master and poll scheduler
+in Modbus_Master.lib.
+
+The sample polls DEVICES Modbus TCP devices (unit addresses 1 to DEVICES)
+through one connection, reading holding registers 0-9, 10-19 and 20-29 of
+each as separate poll table entries.  The poll scheduler merges the three
+into one request per device.  Every 5 seconds it prints the minimum,
+average and maximum poll cycle times, and checks the values read.
+
+Run the simulated slaves, Samples\Modbus\unix\modbus_sim.c, on a PC:
+
+	modbus_sim -n 40 -d 10
+
+and set SIM_IP below to the PC's address.  Then compare DEPTH 1 (one
+request at a time, as with the blocking functions) with DEPTH 4.  With
+"modbus_sim -q", which answers one request at a time like a serial bus,
+there is little to gain from DEPTH beyond hiding the network round trip.
+
+Define USE_RTU to also poll RTU_DEVICES devices on serial port B, as a
+second channel which proceeds in parallel with the TCP one.  Start
+"modbus_sim -s <device> -b 19200" on the PC's serial port for it.
+*/
+#class auto
+
+#define TCPCONFIG 1
+
+#define SIM_IP			"10.10.6.100"
+#define SIM_PORT		1502
+#define DEVICES		40
+#define DEPTH			4			// Requests in flight on the TCP channel
+
+//#define USE_RTU
+#define RTU_DEVICES	4
+#define BINBUFSIZE	255
+#define BOUTBUFSIZE	255
+
+#define MBM_CHANNELS			2
+#define MBM_MAX_INFLIGHT	DEPTH
+#define MBM_POLL_MAXSPANS	(DEVICES + RTU_DEVICES)
+
+#define CH_TCP		0
+#define CH_RTU		1
+
+#memmap xmem
+#use "dcrtcp.lib"
+#use "modbus_master.lib"
+
+tcp_Socket sock;
+
+#define NPOINTS	((DEVICES + RTU_DEVICES) * 3)
+MBM_PollPoint points[NPOINTS];
+int values[NPOINTS][10];
+
+int MBM_Xmit ( int channel, char *frame, int len )
+{
+	if ( channel == CH_RTU )
+	{
+		if ( serBwrFree() < len )
+		{
+			return MB_BUSY;
+		}
+		serBwrite ( frame, len );
+		return MB_SUCCESS;
+	}
+	if ( !sock_established ( &sock ) )
+	{
+		return MBM_PACKET_ERROR;
+	}
+	if ( sock_tbleft ( &sock ) < len )
+	{
+		return MB_BUSY;
+	}
+	sock_fastwrite ( &sock, frame, len );
+	return MB_SUCCESS;
+}
+
+int MBM_Recv ( int channel, char *buf, int len )
+{
+	auto int n;
+
+	if ( channel == CH_RTU )
+	{
+		n = serBrdUsed();
+		if ( n > len )
+		{
+			n = len;
+		}
+		return n ? serBread ( buf, n, 0 ) : 0;
+	}
+	return sock_fastread ( &sock, buf, len );
+}
+
+void MBM_Reset ( int channel )
+{
+	if ( channel == CH_RTU )
+	{
+		serBrdFlush();
+		return;
+	}
+	// main() sees the connection end, and opens a new one
+	sock_abort ( &sock );
+}
+
+int add_points ( int n, int channel, int devices )
+{
+	auto int d, k;
+
+	for ( d = 1; d <= devices; d++ )
+	{
+		for ( k = 0; k < 3; k++, n++ )
+		{
+			points[n].dest = values[n];
+			points[n].reg = k * 10;
+			points[n].count = 10;
+			points[n].channel = channel;
+			points[n].address = d;
+			points[n].function = 0x03;
+		}
+	}
+	return n;
+}
+
+// Count entries which failed, or did not read as modbus_sim's defaults
+int check_points ( int n )
+{
+	auto int i, j, bad;
+
+	bad = 0;
+	for ( i = 0; i < n; i++ )
+	{
+		if ( points[i].status != MB_SUCCESS )
+		{
+			bad++;
+			continue;
+		}
+		for ( j = 0; j < points[i].count; j++ )
+		{
+			if ( points[i].dest[j] != points[i].address * 1000 + points[i].reg + j )
+			{
+				bad++;
+				break;
+			}
+		}
+	}
+	return bad;
+}
+
+void main()
+{
+	auto unsigned long start, report, t, tmin, tmax, total;
+	auto int n, spans, cycles, bad;
+
+	sock_init_or_exit(1);
+
+	MBM_ChannelInit ( CH_TCP, 0, DEPTH, 1000 );
+	n = add_points ( 0, CH_TCP, DEVICES );
+#ifdef USE_RTU
+	serBopen ( 19200 );
+	MBM_ChannelInit ( CH_RTU, 1, 1, 200 );
+	n = add_points ( n, CH_RTU, RTU_DEVICES );
+#endif
+	spans = MBM_PollBuild ( points, n );
+	printf ( "%d poll entries in %d requests per cycle, %d in flight\n",
+			n, spans, DEPTH );
+
+	for (;;)
+	{
+		printf ( "Connecting to %s:%d...\n", SIM_IP, SIM_PORT );
+		tcp_open ( &sock, 0, resolve ( SIM_IP ), SIM_PORT, NULL );
+		while ( !sock_established ( &sock ) )
+		{
+			if ( !tcp_tick ( &sock ) )
+			{
+				break;
+			}
+		}
+		if ( !sock_established ( &sock ) )
+		{
+			continue;
+		}
+
+		cycles = bad = 0;
+		tmin = 0xFFFFFFFF;
+		tmax = total = 0;
+		report = MS_TIMER;
+		while ( tcp_tick ( &sock ) )
+		{
+			start = MS_TIMER;
+			MBM_PollStart();
+			while ( !MBM_PollDone() )
+			{
+				tcp_tick ( NULL );
+				MBM_Tick();
+			}
+			t = MS_TIMER - start;
+			bad += check_points ( n );
+
+			cycles++;
+			total += t;
+			if ( t < tmin ) tmin = t;
+			if ( t > tmax ) tmax = t;
+			if ( MS_TIMER - report >= 5000 )
+			{
+				printf ( "%d cycles: %lu/%lu/%lu ms min/avg/max, %d bad entries\n",
+						cycles, tmin, total / cycles, tmax, bad );
+				cycles = bad = 0;
+				tmin = 0xFFFFFFFF;
+				tmax = total = 0;
+				report = MS_TIMER;
+			}
+		}
+		printf ( "Connection closed\n" );
+		// Let requests in flight time out before reconnecting
+		while ( MBM_Busy() )
+		{
+			MBM_Tick();
+		}
+	}
+}
@@ -0,0 +1,288 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/* Modbus_Slave_Bench.c
+
+Request-to-response latency of Modbus_Slave.lib for large reads.
+
+The sample builds Modbus requests in memory and times msExec(), which
+decodes a request and builds the complete response.  Transport time (TCP
+or serial) is the same in each case and is left out.  Each request is
+timed three ways:
+
+	single	one target function call per register or per coil, as
+				with the standard mbsRegOutRd, mbsDigIn etc.
+	block		one call per request to the MODBUS_SLAVE_BLOCK functions
+				mbsRegOutRdBlk, mbsDigInBlk etc.
+	shadow	served by the library directly from tables attached with
+				mbsShadowMap (MODBUS_SLAVE_SHADOW), with no target calls
+
+The "board I/O" here is just memory, so the single and block times are
+mostly call and loop overhead; on real hardware each target call also
+pays for its own range checks and port access.  All three must produce
+identical responses, which the sample checks.
+
+Finally, a Write Multiple Registers request is sent with the shadow tables
+mapped, to show the change notification.
+*/
+#class auto
+
+#define MY_MODBUS_ADDRESS	1
+#define MODBUS_SLAVE_BLOCK
+#define MODBUS_SLAVE_SHADOW
+
+#define ITERATIONS	200
+#define NREGS			256			// registers in each register table
+#define NCOILS			2048			// coils in each bit table
+
+#use "modbus_slave.lib"
+
+// the simulated board I/O, which is also attached as the shadow tables
+unsigned hold[NREGS], inreg[NREGS];
+char coils[NCOILS / 8], inputs[NCOILS / 8];
+
+#define MODE_SINGLE	0
+#define MODE_BLOCK	1
+#define MODE_SHADOW	2
+#define MODES			3
+int mode;
+const char * const mode_name[MODES] = { "single", "block", "shadow" };
+
+#define REQUESTS		4
+const char request[REQUESTS][6] = {
+	{ MY_MODBUS_ADDRESS, 0x03, 0x00, 0x10, 0x00, 125 },	// 125 holding regs
+	{ MY_MODBUS_ADDRESS, 0x04, 0x00, 0x00, 0x00, 125 },	// 125 input regs
+	{ MY_MODBUS_ADDRESS, 0x01, 0x00, 0x03, 0x07, 0xD0 },	// 2000 coils at 3
+	{ MY_MODBUS_ADDRESS, 0x02, 0x00, 0x00, 0x07, 0xD0 }	// 2000 inputs
+};
+const char * const request_name[REQUESTS] = {
+	"Read 125 holding registers",
+	"Read 125 input registers",
+	"Read 2000 coils",
+	"Read 2000 discrete inputs"
+};
+
+/*
+ *		Target functions required by Modbus_Slave.lib
+ */
+
+void mbsStart ( void ) {}
+void mbsDone ( void ) {}
+
+int mbsDigOutRd ( unsigned CoilNbr, int *pnState )
+{
+	if ( CoilNbr >= NCOILS ) return MB_BADADDR;
+	*pnState = (coils[CoilNbr >> 3] >> (CoilNbr & 7)) & 1;
+	return MB_SUCCESS;
+}
+
+int mbsDigIn ( unsigned InputNbr, int *pnState )
+{
+	if ( InputNbr >= NCOILS ) return MB_BADADDR;
+	*pnState = (inputs[InputNbr >> 3] >> (InputNbr & 7)) & 1;
+	return MB_SUCCESS;
+}
+
+int mbsDigOut ( unsigned CoilNbr, int nState )
+{
+	if ( CoilNbr >= NCOILS ) return MB_BADADDR;
+	if ( nState )
+		coils[CoilNbr >> 3] |= 1 << (CoilNbr & 7);
+	else
+		coils[CoilNbr >> 3] &= ~(1 << (CoilNbr & 7));
+	return MB_SUCCESS;
+}
+
+int mbsRegOutRd ( unsigned RegNbr, unsigned *pwData )
+{
+	if ( RegNbr >= NREGS ) return MB_BADADDR;
+	*pwData = hold[RegNbr];
+	return MB_SUCCESS;
+}
+
+int mbsRegIn ( unsigned RegNbr, unsigned *pwData )
+{
+	if ( RegNbr >= NREGS ) return MB_BADADDR;
+	*pwData = inreg[RegNbr];
+	return MB_SUCCESS;
+}
+
+int mbsRegOut ( unsigned RegNbr, unsigned wData )
+{
+	if ( RegNbr >= NREGS ) return MB_BADADDR;
+	hold[RegNbr] = wData;
+	return MB_SUCCESS;
+}
+
+/*
+ *		Block functions (MODBUS_SLAVE_BLOCK).  Outside MODE_BLOCK they
+ *		decline, so that the library falls back to the functions above.
+ */
+
+int mbsDigOutRdBlk ( unsigned CoilNbr, unsigned CoilCnt, char *pcBits )
+{
+	if ( mode != MODE_BLOCK ) return MB_NOBLOCK;
+	if ( CoilNbr >= NCOILS  ||  CoilCnt > NCOILS - CoilNbr ) return MB_BADADDR;
+	_mbsBitCopy ( pcBits, coils, CoilNbr, CoilCnt );
+	return MB_SUCCESS;
+}
+
+int mbsDigInBlk ( unsigned InputNbr, unsigned InputCnt, char *pcBits )
+{
+	if ( mode != MODE_BLOCK ) return MB_NOBLOCK;
+	if ( InputNbr >= NCOILS  ||  InputCnt > NCOILS - InputNbr ) return MB_BADADDR;
+	_mbsBitCopy ( pcBits, inputs, InputNbr, InputCnt );
+	return MB_SUCCESS;
+}
+
+int mbsRegOutRdBlk ( unsigned RegNbr, unsigned RegCnt, unsigned *pwData )
+{
+	if ( mode != MODE_BLOCK ) return MB_NOBLOCK;
+	if ( RegNbr >= NREGS  ||  RegCnt > NREGS - RegNbr ) return MB_BADADDR;
+	memcpy ( pwData, &hold[RegNbr], RegCnt * sizeof(unsigned) );
+	return MB_SUCCESS;
+}
+
+int mbsRegInBlk ( unsigned RegNbr, unsigned RegCnt, unsigned *pwData )
+{
+	if ( mode != MODE_BLOCK ) return MB_NOBLOCK;
+	if ( RegNbr >= NREGS  ||  RegCnt > NREGS - RegNbr ) return MB_BADADDR;
+	memcpy ( pwData, &inreg[RegNbr], RegCnt * sizeof(unsigned) );
+	return MB_SUCCESS;
+}
+
+/*
+ *		Shadow table change notification (MODBUS_SLAVE_SHADOW)
+ */
+
+void shadow_changed ( int nType, unsigned wFirst, unsigned wCount )
+{
+	printf ( "  notified: table %d, %u register(s) from %u\n",
+		nType, wCount, wFirst );
+}
+
+void set_mode ( int m )
+{
+	mode = m;
+	if ( mode == MODE_SHADOW )
+	{
+		mbsShadowMap ( MBS_COILS, 0, NCOILS, coils );
+		mbsShadowMap ( MBS_INPUTS, 0, NCOILS, inputs );
+		mbsShadowMap ( MBS_HOLDING, 0, NREGS, hold );
+		mbsShadowMap ( MBS_INREGS, 0, NREGS, inreg );
+	}
+	else
+	{
+		mbsShadowMap ( MBS_COILS, 0, 0, NULL );
+		mbsShadowMap ( MBS_INPUTS, 0, 0, NULL );
+		mbsShadowMap ( MBS_HOLDING, 0, 0, NULL );
+		mbsShadowMap ( MBS_INREGS, 0, 0, NULL );
+	}
+}
+
+// Microseconds per request; leaves the response in acMSReply
+unsigned long bench ( const char *req )
+{
+	auto unsigned long t0;
+	auto int i;
+
+	t0 = MS_TIMER;
+	for ( i = 0; i < ITERATIONS; i++ )
+	{
+		memcpy ( acMSCmd, req, 6 );
+		msExec ();
+	}
+	return (MS_TIMER - t0) * 1000L / ITERATIONS;
+}
+
+char reference[REQUESTS][256];
+int reference_len[REQUESTS];
+unsigned long us[REQUESTS][MODES];
+
+main ()
+{
+	auto int i, r, m, len;
+	auto char write_req[7 + 2 * 4];
+
+	for ( i = 0; i < NREGS; i++ )
+	{
+		hold[i] = i * 257;
+		inreg[i] = ~i;
+	}
+	for ( i = 0; i < NCOILS / 8; i++ )
+	{
+		coils[i] = i * 37;
+		inputs[i] = ~i;
+	}
+	mbsShadowNotify = shadow_changed;
+
+	printf ( "Timing %d iterations of each request...\n", ITERATIONS );
+	for ( m = 0; m < MODES; m++ )
+	{
+		set_mode ( m );
+		for ( r = 0; r < REQUESTS; r++ )
+		{
+			us[r][m] = bench ( request[r] );
+			len = pcMSReply - acMSReply;
+			if ( m == MODE_SINGLE )
+			{
+				memcpy ( reference[r], acMSReply, len );
+				reference_len[r] = len;
+			}
+			else if ( len != reference_len[r]  ||
+						 memcmp ( reference[r], acMSReply, len ) )
+			{
+				printf ( "%s: %s response differs!\n",
+					request_name[r], mode_name[m] );
+			}
+		}
+	}
+
+	printf ( "\n%-28s", "us per request" );
+	for ( m = 0; m < MODES; m++ )
+	{
+		printf ( "%9s", mode_name[m] );
+	}
+	printf ( "\n" );
+	for ( r = 0; r < REQUESTS; r++ )
+	{
+		printf ( "%-28s", request_name[r] );
+		for ( m = 0; m < MODES; m++ )
+		{
+			printf ( "%9lu", us[r][m] );
+		}
+		printf ( "\n" );
+	}
+
+	// Write Multiple Registers 100..103, served from the shadow table
+	printf ( "\nWriting holding registers 100-103 with shadow tables mapped\n" );
+	set_mode ( MODE_SHADOW );
+	write_req[0] = MY_MODBUS_ADDRESS;
+	write_req[1] = 0x10;
+	write_req[2] = 0;
+	write_req[3] = 100;
+	write_req[4] = 0;
+	write_req[5] = 4;
+	write_req[6] = 2 * 4;
+	for ( i = 0; i < 4; i++ )
+	{
+		write_req[7 + 2 * i] = 0x12;
+		write_req[8 + 2 * i] = 0x34 + i;
+	}
+	memcpy ( acMSCmd, write_req, sizeof(write_req) );
+	msExec ();
+	printf ( "  hold[100..103] = %04x %04x %04x %04x\n",
+		hold[100], hold[101], hold[102], hold[103] );
+}
@@ -0,0 +1,165 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/* Modbus_TCP_Multi.c
+
+Modbus TCP slave serving several masters at once, with a throughput count.
+
+Up to MB_MAX_SKT masters may connect to MY_MODBUS_PORT together, and each
+may pipeline requests (send more before the earlier responses arrive).
+The "board I/O" is memory: NREGS holding registers and input registers and
+NCOILS coils and discrete inputs, so the figures printed every REPORT_SECS
+seconds show the cost of the TCP and Modbus handling alone.
+
+To load it from a PC, build "Samples\Modbus\unix" and run e.g.
+
+	modbus_load -m 8 -d 4 10.10.6.102
+
+for 8 masters, each keeping 4 requests outstanding.  modbus_load prints the
+rate each master sees; with fair service these should be about equal.
+The same test runs entirely on the PC, against modbus_sim, with
+
+	modbus_sim -d 0 &
+	modbus_load -p 1502 -m 8 -d 4 127.0.0.1
+
+TCP_DATAHANDLER lets the library look only at connections which have had
+TCP activity, instead of polling all of them on each tick.  Each socket
+gets its own MB_SOCK_BUF_SIZE buffer, which holds the requests it has
+queued.
+
+With a BL26xx, MODBUS_GATEWAY passes requests for other unit IDs to
+downstream devices on RS485; see Modbus_Gateway_BL2600.c.
+*/
+#class auto
+
+#define MB_MAX_SKT			8			// masters connected at once
+#define MB_SOCK_BUF_SIZE	1024		// per connection, split between rx and tx
+#define MAX_SOCKETS			(MB_MAX_SKT + 1)
+#define TCP_DATAHANDLER					// service only connections with activity
+
+#define TCPCONFIG 		0
+#define USE_ETHERNET		1
+// set up my IP addresses
+#define IFCONFIG_ETH0 \
+		IFS_IPADDR,aton("10.10.6.102"), 		\
+      IFS_ROUTER_SET, aton("10.10.6.1"),	\
+		IFS_NETMASK,aton("255.255.255.0"),	\
+		IFS_UP
+
+#use dcrtcp.lib
+
+#define MY_MODBUS_ADDRESS	1
+#define MY_MODBUS_PORT 		502	// default tcp/ip port for MODBUS is 502
+
+#use Modbus_Slave.lib				// must be #use'd BEFORE Modbus_Slave_TCP
+#use Modbus_Slave_TCP.lib
+
+#define NREGS			256			// registers in each register table
+#define NCOILS			2048			// coils in each bit table
+#define REPORT_SECS	5
+
+// the simulated board I/O
+unsigned hold[NREGS], inreg[NREGS];
+char coils[NCOILS / 8], inputs[NCOILS / 8];
+
+unsigned long requests;
+
+/*
+ *		Target functions required by Modbus_Slave.lib
+ */
+
+void mbsStart ( void ) { requests++; }
+void mbsDone ( void ) {}
+
+int mbsDigOutRd ( unsigned CoilNbr, int *pnState )
+{
+	if ( CoilNbr >= NCOILS ) return MB_BADADDR;
+	*pnState = (coils[CoilNbr >> 3] >> (CoilNbr & 7)) & 1;
+	return MB_SUCCESS;
+}
+
+int mbsDigIn ( unsigned InputNbr, int *pnState )
+{
+	if ( InputNbr >= NCOILS ) return MB_BADADDR;
+	*pnState = (inputs[InputNbr >> 3] >> (InputNbr & 7)) & 1;
+	return MB_SUCCESS;
+}
+
+int mbsDigOut ( unsigned CoilNbr, int nState )
+{
+	if ( CoilNbr >= NCOILS ) return MB_BADADDR;
+	if ( nState )
+		coils[CoilNbr >> 3] |= 1 << (CoilNbr & 7);
+	else
+		coils[CoilNbr >> 3] &= ~(1 << (CoilNbr & 7));
+	return MB_SUCCESS;
+}
+
+int mbsRegOutRd ( unsigned RegNbr, unsigned *pwData )
+{
+	if ( RegNbr >= NREGS ) return MB_BADADDR;
+	*pwData = hold[RegNbr];
+	return MB_SUCCESS;
+}
+
+int mbsRegIn ( unsigned RegNbr, unsigned *pwData )
+{
+	if ( RegNbr >= NREGS ) return MB_BADADDR;
+	*pwData = inreg[RegNbr];
+	return MB_SUCCESS;
+}
+
+int mbsRegOut ( unsigned RegNbr, unsigned wData )
+{
+	if ( RegNbr >= NREGS ) return MB_BADADDR;
+	hold[RegNbr] = wData;
+	return MB_SUCCESS;
+}
+
+main ()
+{
+	auto unsigned long t0, ticks, last;
+	auto int i, conns;
+
+	for ( i = 0; i < NREGS; i++ )
+	{
+		hold[i] = i;
+		inreg[i] = 1000 + i;
+	}
+
+	sock_init();
+	MODBUS_TCP_Init ( MY_MODBUS_ADDRESS, MY_MODBUS_PORT );
+	printf ( "Modbus TCP slave on port %u, up to %d masters\n",
+		MY_MODBUS_PORT, MB_MAX_SKT );
+
+	t0 = MS_TIMER;
+	ticks = last = 0;
+	while (1)
+	{
+		MODBUS_TCP_tick();
+		ticks++;
+
+		if ( (long)(MS_TIMER - t0) >= REPORT_SECS * 1000L )
+		{
+			for ( i = conns = 0; i < MB_MAX_SKT; i++ )
+				if ( tcp_established ( &mbs_state[i].socket ) ) conns++;
+			printf ( "%d master(s): %lu requests/s, %lu ticks/s\n", conns,
+				(requests - last) / REPORT_SECS, ticks / REPORT_SECS );
+			last = requests;
+			ticks = 0;
+			t0 += REPORT_SECS * 1000L;
+		}
+	}
+}
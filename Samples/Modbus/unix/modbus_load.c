@@ -0,0 +1,300 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/***************************************************************************
+	modbus_load.c
+
+	Modbus TCP load generator, run on a PC, for measuring the throughput
+	of a Modbus TCP slave with several masters connected at once, such as
+	"Samples\Modbus\Modbus_TCP_Multi.c".
+
+	Each of <masters> simulated masters opens its own connection and keeps
+	<depth> Read Holding Registers requests (function 0x03, <count>
+	registers from address 0) outstanding on it.  With several units (-u),
+	each master cycles through them, so that with a gateway some requests
+	are answered locally and the rest share the serial bus.
+
+	Every <interval> seconds it prints the responses per second for each
+	master and in total, the number of exception responses, and the
+	minimum, average and maximum response times.  Responses must come back
+	in order on each connection; anything else is reported and counted as
+	an error.
+
+	To try it without a target, run it against "modbus_sim" on the same
+	PC (modbus_load -p 1502 127.0.0.1).
+
+	Usage:
+
+	% modbus_load [-p port] [-m masters] [-d depth] [-c count]
+	              [-u unit[,unit...]] [-i interval] [-t seconds] host
+
+	Defaults: port 502, 8 masters, depth 1, 10 registers, unit 1,
+	5 second interval, run until interrupted.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#define MAX_MASTERS	64
+#define MAX_DEPTH		16
+#define MAX_UNITS		16
+#define MAX_FRAME		260
+
+struct master {
+	int fd;
+	unsigned short tid;					/* next transaction ID to send */
+	unsigned short expect;				/* next transaction ID to receive */
+	int outstanding;
+	int next_unit;
+	long long sent_at[MAX_DEPTH];		/* us, by tid % depth */
+	unsigned char rx[2 * MAX_FRAME];
+	int rxlen;
+	long responses;						/* this interval */
+};
+
+static struct master masters[MAX_MASTERS];
+static int nmasters = 8;
+static int depth = 1;
+static int count = 10;
+static int units[MAX_UNITS] = { 1 };
+static int nunits = 1;
+
+static long exceptions, errors;
+static long long lat_min, lat_max, lat_sum;
+static long lat_n;
+
+static long long now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void send_request(struct master *m)
+{
+	unsigned char f[12];
+
+	f[0] = m->tid >> 8;
+	f[1] = m->tid;
+	f[2] = f[3] = 0;						/* protocol ID */
+	f[4] = 0;
+	f[5] = 6;								/* unit ID + PDU */
+	f[6] = units[m->next_unit];
+	f[7] = 0x03;
+	f[8] = f[9] = 0;						/* starting address */
+	f[10] = count >> 8;
+	f[11] = count;
+	if (++m->next_unit == nunits)
+		m->next_unit = 0;
+	m->sent_at[m->tid % depth] = now_us();
+	if (write(m->fd, f, sizeof(f)) != sizeof(f)) {
+		perror("write");
+		exit(1);
+	}
+	m->tid++;
+	m->outstanding++;
+}
+
+static void response(struct master *m, unsigned char *f, int len)
+{
+	unsigned short tid = (f[0] << 8) | f[1];
+	long long us;
+
+	if (tid != m->expect) {
+		printf("master %d: response %u, expected %u\n",
+			(int)(m - masters), tid, m->expect);
+		errors++;
+	}
+	us = now_us() - m->sent_at[m->expect % depth];
+	m->expect = tid + 1;
+	m->outstanding--;
+	m->responses++;
+
+	if (f[7] & 0x80)
+		exceptions++;
+	else if (f[7] != 0x03 || f[8] != 2 * count || len != 9 + 2 * count)
+		errors++;
+
+	if (lat_n == 0 || us < lat_min)
+		lat_min = us;
+	if (us > lat_max)
+		lat_max = us;
+	lat_sum += us;
+	lat_n++;
+}
+
+static int connect_to(struct sockaddr_in *sa)
+{
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)sa, sizeof(*sa)) < 0) {
+		perror("connect");
+		exit(1);
+	}
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: modbus_load [-p port] [-m masters] [-d depth] "
+		"[-c count] [-u unit[,unit...]] [-i interval] [-t seconds] host\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in sa;
+	struct hostent *he;
+	struct master *m;
+	fd_set rfds;
+	struct timeval tv;
+	long long start, last, t;
+	long total, lo, hi;
+	int port = 502, interval = 5, seconds = 0;
+	int c, i, n, maxfd, len;
+	char *p;
+
+	while ((c = getopt(argc, argv, "p:m:d:c:u:i:t:")) != -1) {
+		switch (c) {
+		case 'p': port = atoi(optarg); break;
+		case 'm': nmasters = atoi(optarg); break;
+		case 'd': depth = atoi(optarg); break;
+		case 'c': count = atoi(optarg); break;
+		case 'i': interval = atoi(optarg); break;
+		case 't': seconds = atoi(optarg); break;
+		case 'u':
+			for (nunits = 0, p = optarg; *p && nunits < MAX_UNITS; ) {
+				units[nunits++] = strtol(p, &p, 0);
+				if (*p == ',')
+					p++;
+			}
+			break;
+		default: usage();
+		}
+	}
+	if (optind != argc - 1 || nmasters < 1 || nmasters > MAX_MASTERS ||
+	    depth < 1 || depth > MAX_DEPTH || count < 1 || count > 125 ||
+	    nunits < 1 || interval < 1)
+		usage();
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	if (!inet_aton(argv[optind], &sa.sin_addr)) {
+		if ((he = gethostbyname(argv[optind])) == NULL) {
+			fprintf(stderr, "unknown host %s\n", argv[optind]);
+			exit(1);
+		}
+		memcpy(&sa.sin_addr, he->h_addr, sizeof(sa.sin_addr));
+	}
+
+	for (i = 0, m = masters; i < nmasters; i++, m++) {
+		m->fd = connect_to(&sa);
+		m->next_unit = i % nunits;
+	}
+	printf("%d masters, depth %d, %d registers, %d unit(s)\n",
+		nmasters, depth, count, nunits);
+
+	start = last = now_us();
+	for (i = 0, m = masters; i < nmasters; i++, m++)
+		while (m->outstanding < depth)
+			send_request(m);
+
+	for (;;) {
+		FD_ZERO(&rfds);
+		maxfd = 0;
+		for (i = 0, m = masters; i < nmasters; i++, m++) {
+			FD_SET(m->fd, &rfds);
+			if (m->fd > maxfd)
+				maxfd = m->fd;
+		}
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000;
+		if (select(maxfd + 1, &rfds, NULL, NULL, &tv) < 0 && errno != EINTR) {
+			perror("select");
+			exit(1);
+		}
+
+		for (i = 0, m = masters; i < nmasters; i++, m++) {
+			if (!FD_ISSET(m->fd, &rfds))
+				continue;
+			n = read(m->fd, m->rx + m->rxlen, sizeof(m->rx) - m->rxlen);
+			if (n <= 0) {
+				printf("master %d: connection closed by slave\n", i);
+				exit(1);
+			}
+			m->rxlen += n;
+			while (m->rxlen >= 6) {
+				len = 6 + ((m->rx[4] << 8) | m->rx[5]);
+				if (len > MAX_FRAME) {
+					printf("master %d: bad frame length %d\n", i, len);
+					exit(1);
+				}
+				if (m->rxlen < len)
+					break;
+				response(m, m->rx, len);
+				memmove(m->rx, m->rx + len, m->rxlen - len);
+				m->rxlen -= len;
+				send_request(m);
+			}
+		}
+
+		t = now_us();
+		if (t - last >= interval * 1000000LL) {
+			total = 0;
+			lo = hi = masters[0].responses;
+			printf("responses/s:");
+			for (i = 0, m = masters; i < nmasters; i++, m++) {
+				printf(" %ld", (long)(m->responses * 1000000LL / (t - last)));
+				total += m->responses;
+				if (m->responses < lo)
+					lo = m->responses;
+				if (m->responses > hi)
+					hi = m->responses;
+				m->responses = 0;
+			}
+			printf("\n  total %lld/s, slowest master %ld%% of fastest, "
+				"%ld exceptions, %ld errors\n",
+				total * 1000000LL / (t - last), hi ? lo * 100 / hi : 0,
+				exceptions, errors);
+			if (lat_n)
+				printf("  response time min %lld avg %lld max %lld us\n",
+					lat_min, lat_sum / lat_n, lat_max);
+			fflush(stdout);
+			exceptions = 0;
+			lat_n = 0;
+			lat_sum = lat_max = 0;
+			last = t;
+			if (seconds && t - start >= seconds * 1000000LL)
+				break;
+		}
+	}
+	return errors ? 1 : 0;
+}
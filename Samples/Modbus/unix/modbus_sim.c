@@ -0,0 +1,406 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/***************************************************************************
+	modbus_sim.c
+
+	Simulated Modbus slaves, run on a PC, for measuring the poll cycle
+	time of "Samples\Modbus\Modbus_Async_Master.c".
+
+	It answers for unit (slave) addresses 1 to <units>, each with
+	SIM_REGS holding registers and input registers.  Holding register r
+	of unit u reads as u*1000+r until written; input register r reads as
+	u*1000+500+r.  Coil r is on when r is odd.  Each response is sent
+	<delay> ms after its request arrives, to stand in for the time a real
+	device takes.
+
+	Modbus TCP (the default) listens on <port>.  Requests which arrive
+	together are answered in parallel, as by a gateway in front of
+	separate devices; -q answers them one after the other instead, as a
+	serial bus would.  Each master that connects is served by its own
+	process, with its own copy of the registers.
+
+	Modbus RTU (-s) serves the given serial device.  To try it without
+	hardware, make a pair of connected ptys with
+
+		socat -d -d pty,raw,echo=0 pty,raw,echo=0
+
+	and give one of them to -s.
+
+	Usage:
+
+	% modbus_sim [-p port] [-n units] [-d delay] [-q] [-s device [-b baud]]
+
+	Defaults: port 1502, 40 units, 10 ms delay, 19200 baud.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define SIM_REGS		200
+#define SIM_UNITS		247
+#define MAX_PENDING	64
+#define MAX_FRAME		260
+
+static unsigned short holding[SIM_UNITS + 1][SIM_REGS];
+static int units = 40;
+static int delay_ms = 10;
+static int serial_bus = 0;
+
+struct pending {
+	long long due;							/* ms */
+	int len;
+	unsigned char frame[MAX_FRAME];
+};
+static struct pending queue[MAX_PENDING];
+static int qhead, qcount;
+
+static long long now_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static unsigned crc16(const unsigned char *p, int len)
+{
+	unsigned crc = 0xFFFF;
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	}
+	return crc;								/* Low byte goes first on the wire */
+}
+
+/*
+ * Handle one request PDU (starting at the function code) for unit u.
+ * Writes the response PDU to rsp and returns its length.
+ */
+static int handle_pdu(int u, const unsigned char *req, int len,
+                      unsigned char *rsp)
+{
+	int fn = req[0];						/* Callers ensure len >= 1 */
+	unsigned reg, cnt, i, v;
+
+	rsp[0] = fn;
+	if (u < 1 || u > units) {
+		rsp[0] |= 0x80;
+		rsp[1] = 0x0B;						/* Gateway target failed to respond */
+		return 2;
+	}
+	if (len < 5)
+		goto bad_data;
+	reg = (req[1] << 8) | req[2];
+	cnt = (req[3] << 8) | req[4];
+
+
+	switch (fn) {
+	case 0x01:
+		if (cnt < 1 || cnt > 2000)
+			goto bad_data;
+		if (reg + cnt > SIM_REGS)
+			goto bad_addr;
+		rsp[1] = (cnt + 7) / 8;
+		memset(rsp + 2, 0, rsp[1]);
+		for (i = 0; i < cnt; i++)
+			if ((reg + i) & 1)
+				rsp[2 + i / 8] |= 1 << (i % 8);
+		return 2 + rsp[1];
+
+	case 0x03:
+	case 0x04:
+		if (cnt < 1 || cnt > 125)
+			goto bad_data;
+		if (reg + cnt > SIM_REGS)
+			goto bad_addr;
+		rsp[1] = cnt * 2;
+		for (i = 0; i < cnt; i++) {
+			v = fn == 0x03 ? holding[u][reg + i] : u * 1000 + 500 + reg + i;
+			rsp[2 + i * 2] = v >> 8;
+			rsp[3 + i * 2] = v;
+		}
+		return 2 + rsp[1];
+
+	case 0x06:
+		if (reg >= SIM_REGS)
+			goto bad_addr;
+		holding[u][reg] = cnt;
+		memcpy(rsp, req, 5);
+		return 5;
+
+	case 0x10:
+		if (cnt < 1 || cnt > 123 || len < 6 + (int)cnt * 2)
+			goto bad_data;
+		if (reg + cnt > SIM_REGS)
+			goto bad_addr;
+		for (i = 0; i < cnt; i++)
+			holding[u][reg + i] = (req[6 + i * 2] << 8) | req[7 + i * 2];
+		memcpy(rsp, req, 5);
+		return 5;
+	}
+
+	rsp[0] |= 0x80;
+	rsp[1] = 0x01;							/* Illegal function */
+	return 2;
+bad_addr:
+	rsp[0] |= 0x80;
+	rsp[1] = 0x02;
+	return 2;
+bad_data:
+	rsp[0] |= 0x80;
+	rsp[1] = 0x03;
+	return 2;
+}
+
+static void enqueue(const unsigned char *frame, int len)
+{
+	struct pending *p;
+	long long due = now_ms() + delay_ms;
+
+	if (qcount == MAX_PENDING) {
+		fprintf(stderr, "too many requests pending, dropped one\n");
+		return;
+	}
+	if (serial_bus && qcount) {
+		/* One at a time: start after the previous response */
+		p = &queue[(qhead + qcount - 1) % MAX_PENDING];
+		if (p->due + delay_ms > due)
+			due = p->due + delay_ms;
+	}
+	p = &queue[(qhead + qcount++) % MAX_PENDING];
+	p->due = due;
+	p->len = len;
+	memcpy(p->frame, frame, len);
+}
+
+/* Send responses which are due.  Returns ms until the next one, or -1. */
+static int flush_due(int fd)
+{
+	struct pending *p;
+	long long t;
+
+	while (qcount) {
+		p = &queue[qhead];
+		t = now_ms();
+		if (p->due > t)
+			return (int)(p->due - t);
+		if (write(fd, p->frame, p->len) != p->len)
+			perror("write");
+		qhead = (qhead + 1) % MAX_PENDING;
+		qcount--;
+	}
+	return -1;
+}
+
+static int wait_readable(int fd, int ms)
+{
+	fd_set rfds;
+	struct timeval tv;
+
+	FD_ZERO(&rfds);
+	FD_SET(fd, &rfds);
+	tv.tv_sec = ms / 1000;
+	tv.tv_usec = (ms % 1000) * 1000;
+	return select(fd + 1, &rfds, NULL, NULL, ms < 0 ? NULL : &tv);
+}
+
+static void serve_tcp(int port)
+{
+	struct sockaddr_in addr;
+	unsigned char buf[4096], rsp[MAX_FRAME];
+	int ls, fd, one = 1, have, len, n, ms;
+	long requests;
+
+	ls = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(ls, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(ls, 16) < 0) {
+		perror("listen");
+		exit(1);
+	}
+	printf("Modbus TCP on port %d: %d units, %d ms%s\n", port, units,
+	       delay_ms, serial_bus ? ", one at a time" : "");
+	fflush(stdout);
+	signal(SIGCHLD, SIG_IGN);			/* No zombies */
+
+	for (;;) {
+		fd = accept(ls, NULL, NULL);
+		if (fd < 0) {
+			if (errno != EINTR)
+				perror("accept");
+			continue;
+		}
+		if (fork() != 0) {
+			close(fd);						/* The child has it */
+			continue;
+		}
+		close(ls);
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		printf("Master connected\n");
+		have = 0;
+		requests = 0;
+		qhead = qcount = 0;
+
+		for (;;) {
+			ms = flush_due(fd);
+			if (wait_readable(fd, ms) <= 0)
+				continue;
+			n = read(fd, buf + have, sizeof(buf) - have);
+			if (n <= 0)
+				break;
+			have += n;
+
+			/* Handle each complete MBAP frame */
+			while (have >= 7 && have >= 6 + (len = (buf[4] << 8) | buf[5])) {
+				if (len < 2 || len > MAX_FRAME - 6) {
+					have = 0;				/* Lost framing */
+					break;
+				}
+				memcpy(rsp, buf, 7);		/* Transaction, protocol, unit */
+				n = handle_pdu(buf[6], buf + 7, len - 1, rsp + 7);
+				rsp[4] = (n + 1) >> 8;
+				rsp[5] = n + 1;
+				enqueue(rsp, 7 + n);
+				requests++;
+				have -= 6 + len;
+				memmove(buf, buf + 6 + len, have);
+			}
+		}
+		printf("Master disconnected after %ld requests\n", requests);
+		close(fd);
+		exit(0);
+	}
+}
+
+static speed_t baud_code(int baud)
+{
+	switch (baud) {
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	}
+	fprintf(stderr, "unsupported baud rate %d\n", baud);
+	exit(1);
+}
+
+static void serve_rtu(const char *dev, int baud)
+{
+	struct termios tio;
+	unsigned char buf[MAX_FRAME], rsp[MAX_FRAME];
+	int fd, have, n, gap, ms;
+	unsigned crc;
+
+	fd = open(dev, O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		perror(dev);
+		exit(1);
+	}
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, baud_code(baud));
+	cfsetospeed(&tio, baud_code(baud));
+	tcsetattr(fd, TCSANOW, &tio);
+	serial_bus = 1;
+
+	/* A frame ends after 3.5 character times of silence */
+	gap = 35 * 11 * 1000 / 10 / baud + 1;
+	if (gap < 2)
+		gap = 2;
+	printf("Modbus RTU on %s at %d baud: %d units, %d ms\n", dev, baud,
+	       units, delay_ms);
+
+	have = 0;
+	for (;;) {
+		ms = flush_due(fd);
+		if (have && (ms < 0 || ms > gap))
+			ms = gap;
+		if (wait_readable(fd, ms) > 0) {
+			n = read(fd, buf + have, sizeof(buf) - have);
+			if (n > 0)
+				have += n;
+			if (have < (int)sizeof(buf))
+				continue;
+		}
+		if (!have)
+			continue;
+
+		/* Silence (or a full buffer): that is the frame */
+		if (have >= 4 && crc16(buf, have) == 0 && buf[0] != 0) {
+			rsp[0] = buf[0];
+			n = handle_pdu(buf[0], buf + 1, have - 3, rsp + 1) + 1;
+			crc = crc16(rsp, n);
+			rsp[n++] = crc;
+			rsp[n++] = crc >> 8;
+			enqueue(rsp, n);
+		}
+		have = 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = NULL;
+	int port = 1502, baud = 19200;
+	int c, u, r;
+
+	while ((c = getopt(argc, argv, "p:n:d:qs:b:")) != -1) {
+		switch (c) {
+		case 'p': port = atoi(optarg); break;
+		case 'n': units = atoi(optarg); break;
+		case 'd': delay_ms = atoi(optarg); break;
+		case 'q': serial_bus = 1; break;
+		case 's': dev = optarg; break;
+		case 'b': baud = atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-p port] [-n units] [-d delay] [-q] "
+			        "[-s device [-b baud]]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (units < 1 || units > SIM_UNITS)
+		units = SIM_UNITS;
+	for (u = 1; u <= SIM_UNITS; u++)
+		for (r = 0; r < SIM_REGS; r++)
+			holding[u][r] = u * 1000 + r;
+
+	if (dev)
+		serve_rtu(dev, baud);
+	else
+		serve_tcp(port);
+	return 0;
+}
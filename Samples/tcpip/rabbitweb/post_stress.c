@@ -0,0 +1,127 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*******************************************************************************
+        Samples\TcpIp\RabbitWeb\post_stress.c
+
+        POST latency under contention, for RWEB_POST_CONTEXTS.
+
+        The server has one form, /index.zhtml, with a few guarded
+        variables.  Every 5 seconds, the sample prints the number of POST
+        responses per second and the longest time between two of them.
+
+        Load the server from a PC with several clients posting at once:
+
+            ab -n 1000 -c 3 -p post.txt -T application/x-www-form-urlencoded
+               http://<board address>/index.zhtml
+
+        where post.txt holds, for example, "speed=10&limit=20&mode=1".  At
+        the same time, hold a POST open from another client, the way a
+        slow link or a stalled browser does:
+
+            (printf "POST /index.zhtml HTTP/1.0\r\nContent-Length: 30\r\n\r\n";
+             sleep 20) | nc <board address> 80
+
+        ab reports the latency of its POSTs.  Run the sample once as it
+        is, then with RWEB_POST_CONTEXTS defined as 1 below, which is the
+        single POST lock of earlier releases: every POST then waits for
+        the slow one to time out.
+*******************************************************************************/
+#class auto
+
+/*
+ * Pick the predefined TCP/IP configuration for this sample.  See
+ * LIB\TCPIP\TCP_CONFIG.LIB for instructions on how to set the
+ * configuration.
+ */
+#define TCPCONFIG 1
+
+#define USE_RABBITWEB 1
+
+#define HTTP_MAXSERVERS			4
+#define MAX_TCP_SOCKET_BUFFERS	4
+
+// POST requests that may be in progress at once (defaults to 4 here)
+// #define RWEB_POST_CONTEXTS		1
+
+// Called for every 200 response: count the POSTs.  Adds no header.
+#define HTTP_CUSTOM_HEADERS(state, buf, len)		bench_count(state)
+void bench_count();
+
+#memmap xmem
+#use "dcrtcp.lib"
+#use "http.lib"
+
+#ximport "samples/tcpip/rabbitweb/pages/post_stress.zhtml" post_stress_zhtml
+
+SSPEC_MIMETABLE_START
+	SSPEC_MIME_FUNC(".zhtml", "text/html", zhtml_handler),
+	SSPEC_MIME(".html", "text/html")
+SSPEC_MIMETABLE_END
+
+SSPEC_RESOURCETABLE_START
+	SSPEC_RESOURCE_XMEMFILE("/", post_stress_zhtml),
+	SSPEC_RESOURCE_XMEMFILE("/index.zhtml", post_stress_zhtml)
+SSPEC_RESOURCETABLE_END
+
+int speed;
+int limit;
+int mode;
+
+#web speed (($speed >= 0) && ($speed <= 100))
+#web limit (($limit >= $speed) && ($limit <= 100))
+#web mode (($mode >= 0) && ($mode <= 3))
+
+longword posts, last_post, max_gap;
+
+void bench_count(HttpState * state)
+{
+	longword now;
+
+	if (state->method == HTTP_METHOD_POST) {
+		now = MS_TIMER;
+		if (posts && now - last_post > max_gap)
+			max_gap = now - last_post;
+		last_post = now;
+		posts++;
+	}
+}
+
+void main(void)
+{
+	longword start, elapsed;
+
+	speed = 10;
+	limit = 20;
+	mode = 1;
+
+	sock_init_or_exit(1);
+	http_init();
+	tcp_reserveport(80);
+
+	printf("%d servers, %d POST contexts\n", HTTP_MAXSERVERS,
+		RWEB_POST_CONTEXTS);
+
+	for (;;) {
+		posts = max_gap = 0;
+		start = MS_TIMER;
+		while ((elapsed = MS_TIMER - start) < 5000)
+			http_handler();
+
+		if (posts)
+			printf("%lu POSTs, %.1f per second, longest gap %lu ms\n",
+				posts, posts * 1000.0 / elapsed, max_gap);
+	}
+}
@@ -0,0 +1,106 @@
+/*
+   Copyright (c) 2015, Digi International Inc.
+
+   Permission to use, copy, modify, and/or distribute this software for any
+   purpose with or without fee is hereby granted, provided that the above
+   copyright notice and this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+   WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+   ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+   WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+   ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/***************************************************************************
+	unix_syslog_recv.c
+
+	A minimal syslog collector, used on the PC side to receive log
+	messages from a Rabbit board running
+	"Samples\tcpip\udp\log_syslog.c".
+
+	Using "unix_syslog_recv":
+	-------------------------
+
+	% unix_syslog_recv [<port>]
+
+	The port defaults to 5140.  Each datagram may contain several
+	RFC 5424 messages, one per line.  Every message is printed, and the
+	PROCID field (which LOG.LIB sets to the log entry serial number) is
+	checked so that gaps caused by dropped messages are reported.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+
+#define LISTEN_PORT 5140
+
+/* Return the PROCID (5th space-separated field) of a message, or 0. */
+static unsigned long procid(const char *msg)
+{
+	int field;
+
+	for (field = 1; field < 5; field++) {
+		msg = strchr(msg, ' ');
+		if (!msg)
+			return 0;
+		msg++;
+	}
+	return strtoul(msg, NULL, 10);
+}
+
+int main(int argc, char* argv[])
+{
+	int sock;
+	struct sockaddr_in sin;
+	char data[2048];
+	char *line, *next;
+	unsigned long serial, expect, msgs, dgrams, lost;
+	int len;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	sin.sin_port = htons(argc > 1 ? atoi(argv[1]) : LISTEN_PORT);
+
+	sock = socket(PF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		perror("socket() failed!");
+		return 2;
+	}
+	if (bind(sock, (struct sockaddr *) &sin, sizeof(sin)) < 0) {
+		perror("bind() failed!");
+		return 2;
+	}
+
+	expect = msgs = dgrams = lost = 0;
+	for (;;) {
+		len = recv(sock, data, sizeof(data) - 1, 0);
+		if (len < 0) {
+			perror("recv() failed!");
+			return 1;
+		}
+		data[len] = '\0';
+		dgrams++;
+		for (line = data; line; line = next) {
+			next = strchr(line, '\n');
+			if (next)
+				*next++ = '\0';
+			msgs++;
+			serial = procid(line);
+			if (expect && serial > expect)
+				lost += serial - expect;
+			expect = serial + 1;
+			printf("%s\n", line);
+		}
+		printf("-- %lu messages in %lu datagrams, %lu lost\n", msgs, dgrams, lost);
+	}
+}   /* end main() */